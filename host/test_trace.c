@@ -0,0 +1,222 @@
+//functional tests for the trace codec, the serial log parser and the game hooks
+//the replay tool depends on, run by ctest
+
+//libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "trace.h"
+#include "trace_log.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+//platform hooks, the game logic only needs them to exist here
+void send_ready(const char* msg) {
+    (void)msg;
+}
+
+void game_delay_ms(int ms) {
+    (void)ms;
+}
+
+static void test_header() {
+    uint8_t buf[TRACE_HEADER_SIZE];
+    CHECK(trace_write_header(buf, sizeof(buf) - 1) == 0);
+    CHECK(trace_write_header(buf, sizeof(buf)) == TRACE_HEADER_SIZE);
+    CHECK(trace_read_header(buf, sizeof(buf)));
+    CHECK(!trace_read_header(buf, sizeof(buf) - 1));
+
+    buf[4] = TRACE_VERSION + 1;
+    CHECK(!trace_read_header(buf, sizeof(buf)));
+    buf[4] = TRACE_VERSION;
+    buf[0] = 'X';
+    CHECK(!trace_read_header(buf, sizeof(buf)));
+}
+
+static void test_varint_round_trip() {
+    const uint64_t deltas[] = {0, 1, 127, 128, 16383, 16384, 0xffffffffull, 0x8000000000000000ull, UINT64_MAX};
+    const size_t sizes[] = {1, 1, 1, 2, 2, 3, 5, 10, 10};
+
+    for (size_t i = 0; i < sizeof(deltas) / sizeof(deltas[0]); i++) {
+        uint8_t buf[TRACE_MAX_EVENT_SIZE];
+        size_t n = trace_encode_event(buf, sizeof(buf), deltas[i], TRACE_EVENT_UART_LINE, "1 2", 3);
+        CHECK(n == sizes[i] + 2 + 3);
+
+        trace_event_t event;
+        size_t pos = 0;
+        CHECK(trace_decode_event(buf, n, &pos, &event) == 1);
+        CHECK(pos == n);
+        CHECK(event.delta_us == deltas[i]);
+        CHECK(event.type == TRACE_EVENT_UART_LINE);
+        CHECK(event.len == 3 && strcmp((const char *)event.payload, "1 2") == 0);
+        CHECK(trace_decode_event(buf, n, &pos, &event) == 0);
+    }
+}
+
+static void test_encode_limits() {
+    uint8_t big[300];
+    uint8_t buf[TRACE_MAX_EVENT_SIZE];
+    memset(big, 'a', sizeof(big));
+
+    //payloads longer than a length byte can hold are cut to TRACE_MAX_PAYLOAD
+    size_t n = trace_encode_event(buf, sizeof(buf), 0, TRACE_EVENT_MQTT_DATA, big, sizeof(big));
+    CHECK(n == 1 + 2 + TRACE_MAX_PAYLOAD);
+    trace_event_t event;
+    size_t pos = 0;
+    CHECK(trace_decode_event(buf, n, &pos, &event) == 1);
+    CHECK(event.len == TRACE_MAX_PAYLOAD);
+
+    //an event that doesn't fit writes nothing
+    CHECK(trace_encode_event(buf, 1 + 2 + 4, 0, TRACE_EVENT_UART_LINE, "1 2 3", 5) == 0);
+    CHECK(trace_encode_event(buf, 1 + 2 + 5, 0, TRACE_EVENT_UART_LINE, "1 2 3", 5) == 1 + 2 + 5);
+    CHECK(trace_encode_event(buf, 3, 0, TRACE_EVENT_TRUNCATED, NULL, 0) == 3);
+    CHECK(trace_encode_event(buf, 2, 0, TRACE_EVENT_TRUNCATED, NULL, 0) == 0);
+    CHECK(trace_encode_event(buf, TRACE_MARKER_SIZE, UINT64_MAX, TRACE_EVENT_TRUNCATED, NULL, 0) == TRACE_MARKER_SIZE);
+}
+
+static void test_decode_corrupt() {
+    trace_event_t event;
+    size_t pos;
+
+    //payload cut short
+    const uint8_t short_payload[] = {0x00, TRACE_EVENT_UART_LINE, 3, '1', ' '};
+    pos = 0;
+    CHECK(trace_decode_event(short_payload, sizeof(short_payload), &pos, &event) == -1);
+    CHECK(pos == 0);
+
+    //varint still continuing at the end of the data
+    const uint8_t open_varint[] = {0x80, 0x80};
+    pos = 0;
+    CHECK(trace_decode_event(open_varint, sizeof(open_varint), &pos, &event) == -1);
+
+    //varint longer than 64 bits
+    uint8_t long_varint[14];
+    memset(long_varint, 0x80, 11);
+    long_varint[11] = 0x01;
+    long_varint[12] = TRACE_EVENT_AI_TICK;
+    long_varint[13] = 0;
+    pos = 0;
+    CHECK(trace_decode_event(long_varint, sizeof(long_varint), &pos, &event) == -1);
+
+    //missing type and length bytes
+    const uint8_t no_type[] = {0x05};
+    pos = 0;
+    CHECK(trace_decode_event(no_type, sizeof(no_type), &pos, &event) == -1);
+
+    //unknown event types
+    const uint8_t type_zero[] = {0x00, 0, 0};
+    pos = 0;
+    CHECK(trace_decode_event(type_zero, sizeof(type_zero), &pos, &event) == -1);
+    const uint8_t type_high[] = {0x00, TRACE_EVENT_COUNT, 0};
+    pos = 0;
+    CHECK(trace_decode_event(type_high, sizeof(type_high), &pos, &event) == -1);
+}
+
+static void test_seed_and_names() {
+    uint8_t buf[16];
+    const uint8_t seed[4] = {0x78, 0x56, 0x34, 0x12};
+    size_t n = trace_encode_event(buf, sizeof(buf), 0, TRACE_EVENT_SEED, seed, sizeof(seed));
+    trace_event_t event;
+    size_t pos = 0;
+    CHECK(trace_decode_event(buf, n, &pos, &event) == 1);
+    CHECK(trace_seed_from_event(&event) == 0x12345678u);
+
+    CHECK(strcmp(trace_event_name(TRACE_EVENT_AI_TICK), "ai_tick") == 0);
+    CHECK(strcmp(trace_event_name(TRACE_EVENT_TRUNCATED), "truncated") == 0);
+    CHECK(strcmp(trace_event_name(0), "unknown") == 0);
+    CHECK(strcmp(trace_event_name(TRACE_EVENT_COUNT), "unknown") == 0);
+}
+
+//decode a log held in a string, in place like the replay tool does
+static long decode_log(const char *log, uint8_t *out) {
+    size_t len = strlen(log);
+    char *text = malloc(len + 1);
+    memcpy(text, log, len + 1);
+    long n = trace_decode_log(text, len, (uint8_t *)text);
+    if (n > 0) {
+        memcpy(out, text, n);
+    }
+    free(text);
+    return n;
+}
+
+static void test_log_parser() {
+    uint8_t out[64];
+
+    CHECK(decode_log("TRACE-BEGIN 3\nTRACE:0a0B0c\nTRACE-END\n", out) == 3);
+    CHECK(out[0] == 0x0a && out[1] == 0x0b && out[2] == 0x0c);
+
+    //only the last dump counts, and other console output around the blocks is ignored
+    CHECK(decode_log("I (1) boot\nTRACE-BEGIN 1\nTRACE:01\nTRACE-END\nI (2) TicTacToe: MQTT Connected\n"
+                     "TRACE-BEGIN 2\nTRACE:0203\nTRACE-END\nEnter your choice (1-3): ", out) == 2);
+    CHECK(out[0] == 0x02 && out[1] == 0x03);
+
+    //lines split across several TRACE: lines and CRLF line endings
+    CHECK(decode_log("TRACE-BEGIN 4\r\nTRACE:0102\r\nTRACE:0304\r\nTRACE-END\r\n", out) == 4);
+    CHECK(out[3] == 0x04);
+
+    //a line broken up by other output
+    CHECK(decode_log("TRACE-BEGIN 4\nTRACE:01I (5) x\n0203\nTRACE-END\n", out) == -1);
+    CHECK(decode_log("TRACE-BEGIN 2\nTRACE:01zz\nTRACE-END\n", out) == -1);
+    CHECK(decode_log("TRACE-BEGIN 1\nTRACE:012\nTRACE-END\n", out) == -1);
+
+    //byte count doesn't match TRACE-BEGIN
+    CHECK(decode_log("TRACE-BEGIN 3\nTRACE:0102\nTRACE-END\n", out) == -1);
+    CHECK(decode_log("TRACE-BEGIN 1\nTRACE:0102\nTRACE-END\n", out) == -1);
+
+    //missing or unusable framing
+    CHECK(decode_log("TRACE:0102\nTRACE-END\n", out) == -1);
+    CHECK(decode_log("TRACE-BEGIN 2\nTRACE:0102\n", out) == -1);
+    CHECK(decode_log("TRACE-BEGIN x\nTRACE:0102\nTRACE-END\n", out) == -1);
+    CHECK(decode_log("TRACE-BEGIN 2", out) == -1);
+}
+
+static void test_game_hooks() {
+    uint8_t state[GAME_STATE_SIZE];
+
+    game_reset();
+    CHECK(game_snapshot(state) == GAME_STATE_SIZE);
+    CHECK(memcmp(state, "         X", 10) == 0);
+    CHECK(state[10] == MODE_MENU && state[11] == 0 && state[12] == 0);
+
+    //the automated game poll only moves when it's the AI's turn
+    current_mode = MODE_AI_PLAYERS;
+    game_started = true;
+    currentPlayer = 'O';
+    game_handle_ai_tick();
+    game_snapshot(state);
+    CHECK(memcmp(state, "         O", 10) == 0);
+
+    currentPlayer = 'X';
+    CHECK(game_ai_move_due());
+    game_handle_ai_tick();
+    CHECK(board[1][1] == 'X');
+    CHECK(currentPlayer == 'O');
+    CHECK(!game_ai_move_due());
+}
+
+int main() {
+    //the game prints its board, failures and the summary go to stderr
+    if (!freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+
+    test_header();
+    test_varint_round_trip();
+    test_encode_limits();
+    test_decode_corrupt();
+    test_seed_and_names();
+    test_log_parser();
+    test_game_hooks();
+
+    fprintf(stderr, "%s: %d failure(s)\n", failures ? "FAILED" : "passed", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+//libraries
+#include <stdio.h>
+#include <string.h>
+#include "trace_log.h"
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+//pull the bytes out of the last TRACE-BEGIN/TRACE-END block of a serial log
+//every dump repeats the whole buffer, so only the last one is needed
+long trace_decode_log(const char *text, size_t len, uint8_t *out) {
+    const char *end = text + len;
+    const char *block = NULL;
+    unsigned expected = 0;
+
+    for (const char *p = text; p < end; ) {
+        const char *eol = memchr(p, '\n', end - p);
+        if (!eol) {
+            eol = end;
+        }
+        //the length is parsed within the line, the log isn't '\0' terminated
+        if (eol - p > 12 && memcmp(p, "TRACE-BEGIN ", 12) == 0) {
+            const char *d = p + 12;
+            unsigned n = 0;
+            while (d < eol && *d >= '0' && *d <= '9' && n < 100000000) {
+                n = n * 10 + (*d++ - '0');
+            }
+            if (d > p + 12) {
+                block = eol;
+                expected = n;
+            }
+        }
+        p = eol + 1;
+    }
+    if (!block) {
+        fprintf(stderr, "no TRACE-BEGIN line found\n");
+        return -1;
+    }
+
+    size_t n = 0;
+    int line = 0;
+    for (const char *p = block < end ? block + 1 : end; p < end; ) {
+        const char *eol = memchr(p, '\n', end - p);
+        if (!eol) {
+            eol = end;
+        }
+        const char *stop = eol;
+        if (stop > p && stop[-1] == '\r') {
+            stop--;
+        }
+        line++;
+        if (stop - p == 9 && memcmp(p, "TRACE-END", 9) == 0) {
+            if (n != expected) {
+                fprintf(stderr, "trace block holds %zu bytes but TRACE-BEGIN announced %u\n", n, expected);
+                return -1;
+            }
+            return (long)n;
+        }
+        //a line that isn't all hex was broken up by other console output
+        if (stop - p < 6 || memcmp(p, "TRACE:", 6) != 0 || (stop - p - 6) % 2 != 0) {
+            fprintf(stderr, "line %d of the last trace block is damaged\n", line);
+            return -1;
+        }
+        for (const char *h = p + 6; h < stop; h += 2) {
+            if (hex_value(h[0]) < 0 || hex_value(h[1]) < 0) {
+                fprintf(stderr, "line %d of the last trace block is damaged\n", line);
+                return -1;
+            }
+            out[n++] = (uint8_t)(hex_value(h[0]) << 4 | hex_value(h[1]));
+        }
+        p = eol + 1;
+    }
+    fprintf(stderr, "last trace block has no TRACE-END line\n");
+    return -1;
+}
@@ -0,0 +1,12 @@
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//decode the trace from a serial monitor log holding the TRACE-BEGIN/TRACE:/TRACE-END
+//lines printed by trace_dump(), out may be the text itself (hex never expands)
+//returns the decoded length or -1 (after printing why) if the last block is damaged
+long trace_decode_log(const char *text, size_t len, uint8_t *out);
+
+#endif
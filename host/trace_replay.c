@@ -0,0 +1,445 @@
+//host replay engine for traces recorded on the ESP32
+//
+//feeds every recorded input back into the game logic from main/game.c,
+//times how long each one takes to process and prints the final game state
+//
+//usage: trace_replay [--realtime] [--iterations N] [--budget-us N] [--verbose] TRACE
+//
+//TRACE is either a binary trace or a serial monitor log containing the
+//TRACE: lines printed by typing "trace" on the device console
+//
+//the state event the device records on every dump is checked against the
+//replayed game, so a replay that doesn't end where the device did is an error
+
+//libraries
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "game.h"
+#include "trace.h"
+#include "trace_log.h"
+
+//exit codes
+#define EXIT_USAGE 1
+#define EXIT_DIVERGED 2
+#define EXIT_OVER_BUDGET 3
+#define EXIT_TRUNCATED 4
+
+//final state of one replay
+typedef struct {
+    char board[3][3];
+    char currentPlayer;
+    game_mode_t mode;
+    bool game_started;
+    bool mqtt_connected;
+    unsigned ready_count;
+    char last_ready[16];
+} replay_state_t;
+
+static bool verbose = false;
+static FILE *report = NULL;
+
+//platform hook state, reset before every iteration
+static unsigned ready_count = 0;
+static char last_ready[16] = "";
+static long long delay_ms_total = 0;
+
+//result of checking the recorded state events against the replay
+typedef struct {
+    size_t checked;
+    bool truncated;
+    size_t truncated_index;
+    bool diverged;
+    size_t event_index;
+    uint8_t expected[GAME_STATE_SIZE];
+    uint8_t actual[GAME_STATE_SIZE];
+} state_check_t;
+
+//publish ready status, same connection check as the device
+void send_ready(const char* msg) {
+    if (mqtt_connected) {
+        ready_count++;
+        snprintf(last_ready, sizeof(last_ready), "%s", msg);
+        if (verbose) {
+            printf("[ready] %s\n", msg);
+        }
+    }
+}
+
+//the device blocks here, the replay only keeps count so runs are as fast as possible
+void game_delay_ms(int ms) {
+    delay_ms_total += ms;
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t deadline) {
+    uint64_t now = now_ns();
+    if (deadline > now) {
+        uint64_t wait = deadline - now;
+        struct timespec ts = { (time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull) };
+        nanosleep(&ts, NULL);
+    }
+}
+
+//load a trace file, returns NULL (after printing why) if it can't be used
+static uint8_t *load_trace(const char *path, size_t *out_len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        perror(path);
+        fclose(f);
+        return NULL;
+    }
+
+    uint8_t *data = malloc(size + 1);
+    if (!data || fread(data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    data[size] = '\0';
+
+    size_t len = size;
+    if (!trace_read_header(data, len)) {
+        //not a binary trace, try it as a serial log (hex never expands, decode in place)
+        long decoded = trace_decode_log((const char *)data, len, data);
+        if (decoded < 0) {
+            fprintf(stderr, "%s: unusable serial log\n", path);
+            free(data);
+            return NULL;
+        }
+        len = (size_t)decoded;
+        if (!trace_read_header(data, len)) {
+            fprintf(stderr, "%s: not a trace (bad magic or version)\n", path);
+            free(data);
+            return NULL;
+        }
+    }
+    *out_len = len;
+    return data;
+}
+
+//decode every event up front so only the game logic is inside the timed region
+static trace_event_t *decode_trace(const uint8_t *data, size_t len, size_t *out_count) {
+    size_t cap = 64;
+    size_t count = 0;
+    size_t pos = TRACE_HEADER_SIZE;
+    trace_event_t *events = malloc(cap * sizeof(*events));
+
+    while (events) {
+        if (count == cap) {
+            cap *= 2;
+            trace_event_t *grown = realloc(events, cap * sizeof(*events));
+            if (!grown) {
+                break;
+            }
+            events = grown;
+        }
+        int rc = trace_decode_event(data, len, &pos, &events[count]);
+        if (rc == 0) {
+            *out_count = count;
+            return events;
+        }
+        if (rc < 0) {
+            fprintf(stderr, "trace is corrupt at byte %zu (after %zu events)\n", pos, count);
+            break;
+        }
+        count++;
+    }
+    free(events);
+    return NULL;
+}
+
+//compare the replayed game against a state recorded on the device
+static void check_state(const trace_event_t *event, size_t index, state_check_t *check) {
+    uint8_t actual[GAME_STATE_SIZE];
+    game_snapshot(actual);
+    check->checked++;
+    if (!check->diverged && (event->len != GAME_STATE_SIZE || memcmp(actual, event->payload, GAME_STATE_SIZE) != 0)) {
+        check->diverged = true;
+        check->event_index = index;
+        memset(check->expected, 0, sizeof(check->expected));
+        memcpy(check->expected, event->payload, event->len < GAME_STATE_SIZE ? event->len : GAME_STATE_SIZE);
+        memcpy(check->actual, actual, sizeof(actual));
+    }
+}
+
+static void dispatch(const trace_event_t *event, size_t index, state_check_t *check) {
+    switch (event->type) {
+        case TRACE_EVENT_SEED:
+            srand(trace_seed_from_event(event));
+            break;
+        case TRACE_EVENT_UART_LINE:
+            game_handle_uart_line((const char *)event->payload);
+            break;
+        case TRACE_EVENT_MQTT_CONNECTED:
+            game_handle_mqtt_connected();
+            break;
+        case TRACE_EVENT_MQTT_DISCONNECTED:
+            game_handle_mqtt_disconnected();
+            break;
+        case TRACE_EVENT_MQTT_DATA:
+            game_handle_mqtt_data((const char *)event->payload, event->len);
+            break;
+        case TRACE_EVENT_AI_TICK:
+            game_handle_ai_tick();
+            break;
+        case TRACE_EVENT_STATE:
+            check_state(event, index, check);
+            break;
+        case TRACE_EVENT_TRUNCATED:
+            check->truncated = true;
+            check->truncated_index = index;
+            break;
+        default:
+            break;
+    }
+}
+
+static void snapshot_state(replay_state_t *state) {
+    memset(state, 0, sizeof(*state));
+    memcpy(state->board, board, sizeof(board));
+    state->currentPlayer = currentPlayer;
+    state->mode = current_mode;
+    state->game_started = game_started;
+    state->mqtt_connected = mqtt_connected;
+    state->ready_count = ready_count;
+    memcpy(state->last_ready, last_ready, sizeof(last_ready));
+}
+
+//replay every event once, latencies[i] gets the processing time of events[i]
+static void replay(const trace_event_t *events, size_t count, bool realtime, uint64_t *latencies, state_check_t *check) {
+    game_reset();
+    ready_count = 0;
+    last_ready[0] = '\0';
+    delay_ms_total = 0;
+
+    uint64_t start = now_ns();
+    uint64_t offset_ns = 0;
+    for (size_t i = 0; i < count; i++) {
+        offset_ns += events[i].delta_us * 1000ull;
+        if (realtime) {
+            sleep_until_ns(start + offset_ns);
+        }
+        if (verbose) {
+            printf("[event %zu] %s %s\n", i, trace_event_name(events[i].type),
+                   events[i].type == TRACE_EVENT_SEED || events[i].type == TRACE_EVENT_STATE ? "" : (const char *)events[i].payload);
+        }
+        uint64_t t0 = now_ns();
+        dispatch(&events[i], i, check);
+        latencies[i] = now_ns() - t0;
+    }
+    fflush(stdout);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+//print one row of the latency table, sorts samples in place, returns the p99
+//the p99 is nearest-rank, with fewer than 100 samples it is the maximum
+static uint64_t report_latency(const char *name, uint64_t *samples, size_t n) {
+    if (n == 0) {
+        return 0;
+    }
+    qsort(samples, n, sizeof(*samples), compare_u64);
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += samples[i];
+    }
+    uint64_t p99 = samples[(n * 99 + 99) / 100 - 1];
+    fprintf(report, "  %-18s %8zu %10.2f %10.2f %10.2f %10.2f %10.2f\n", name, n,
+            samples[0] / 1000.0, (double)total / n / 1000.0, samples[(n - 1) / 2] / 1000.0,
+            p99 / 1000.0, samples[n - 1] / 1000.0);
+    return p99;
+}
+
+static const char *mode_name(game_mode_t mode) {
+    switch (mode) {
+        case MODE_MENU: return "menu";
+        case MODE_ONE_PLAYER: return "one player";
+        case MODE_TWO_PLAYER: return "two player";
+        case MODE_AI_PLAYERS: return "automate play";
+    }
+    return "unknown";
+}
+
+static void report_snapshot(const char *label, const uint8_t *state) {
+    fprintf(report, "  %s: mode %s, game started %s, mqtt connected %s, current player %c, board [%.3s|%.3s|%.3s]\n",
+            label, mode_name((game_mode_t)state[10]), state[11] ? "yes" : "no", state[12] ? "yes" : "no",
+            state[9], (const char *)state, (const char *)state + 3, (const char *)state + 6);
+}
+
+static void report_state(const replay_state_t *state) {
+    fprintf(report, "\nfinal state:\n");
+    fprintf(report, "  mode: %s, game started: %s, mqtt connected: %s\n", mode_name(state->mode),
+            state->game_started ? "yes" : "no", state->mqtt_connected ? "yes" : "no");
+    fprintf(report, "  current player: %c\n", state->currentPlayer);
+    fprintf(report, "  ready messages published: %u (last: %s)\n", state->ready_count,
+            state->last_ready[0] ? state->last_ready : "none");
+    fprintf(report, "  board:\n");
+    for (int i = 0; i < 3; i++) {
+        fprintf(report, "     %c | %c | %c \n", state->board[i][0], state->board[i][1], state->board[i][2]);
+        if (i < 2)
+            fprintf(report, "    ---+---+---\n");
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--realtime] [--iterations N] [--budget-us N] [--verbose] TRACE\n", prog);
+    fprintf(stderr, "  --realtime      replay at the recorded timing instead of as fast as possible\n");
+    fprintf(stderr, "  --iterations N  replay the trace N times and aggregate latencies (default 1)\n");
+    fprintf(stderr, "  --budget-us N   exit with status %d if the p99 event latency exceeds N microseconds,\n", EXIT_OVER_BUDGET);
+    fprintf(stderr, "                  use it with --iterations, a short trace has too few samples for a real p99\n");
+    fprintf(stderr, "  --verbose       show the game's console output and every replayed event\n");
+}
+
+int main(int argc, char **argv) {
+    bool realtime = false;
+    long iterations = 1;
+    double budget_us = 0;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--budget-us") == 0 && i + 1 < argc) {
+            budget_us = strtod(argv[++i], NULL);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_USAGE;
+        }
+    }
+    if (!path || iterations < 1) {
+        usage(argv[0]);
+        return EXIT_USAGE;
+    }
+
+    size_t len = 0;
+    uint8_t *data = load_trace(path, &len);
+    if (!data) {
+        return EXIT_USAGE;
+    }
+    size_t count = 0;
+    trace_event_t *events = decode_trace(data, len, &count);
+    free(data);
+    if (!events) {
+        return EXIT_USAGE;
+    }
+
+    //the report keeps the real stdout, the game's printf output is discarded unless verbose
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    if (!report) {
+        perror("stdout");
+        return EXIT_USAGE;
+    }
+    if (!verbose && !freopen("/dev/null", "w", stdout)) {
+        perror("/dev/null");
+        return EXIT_USAGE;
+    }
+
+    uint64_t *latencies = malloc((count ? count : 1) * iterations * sizeof(*latencies));
+    if (!latencies) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_USAGE;
+    }
+
+    state_check_t check;
+    replay_state_t state;
+    uint64_t wall_start = now_ns();
+    for (long it = 0; it < iterations; it++) {
+        memset(&check, 0, sizeof(check));
+        replay(events, count, realtime, latencies + it * count, &check);
+    }
+    uint64_t wall_ns = now_ns() - wall_start;
+    snapshot_state(&state);
+
+    uint64_t recorded_us = 0;
+    size_t type_count[TRACE_EVENT_COUNT] = {0};
+    for (size_t i = 0; i < count; i++) {
+        recorded_us += events[i].delta_us;
+        type_count[events[i].type]++;
+    }
+
+    fprintf(report, "trace: %s\n", path);
+    fprintf(report, "events: %zu over %.3f s recorded, %ld iteration(s)%s\n", count,
+            recorded_us / 1e6, iterations, realtime ? " at recorded timing" : "");
+    fprintf(report, "replay wall time: %.3f ms (%.0f events/s), game delays skipped: %lld ms per iteration\n",
+            wall_ns / 1e6, wall_ns ? count * iterations / (wall_ns / 1e9) : 0.0, delay_ms_total);
+
+    fprintf(report, "\nper-event latency (us):\n");
+    fprintf(report, "  %-18s %8s %10s %10s %10s %10s %10s\n", "event", "count", "min", "mean", "p50", "p99", "max");
+    uint64_t *samples = malloc((count ? count : 1) * iterations * sizeof(*samples));
+    if (!samples) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_USAGE;
+    }
+    for (int type = 1; type < TRACE_EVENT_COUNT; type++) {
+        if (type_count[type] == 0) {
+            continue;
+        }
+        size_t n = 0;
+        for (long it = 0; it < iterations; it++) {
+            for (size_t i = 0; i < count; i++) {
+                if (events[i].type == type) {
+                    samples[n++] = latencies[it * count + i];
+                }
+            }
+        }
+        report_latency(trace_event_name(type), samples, n);
+    }
+    uint64_t p99 = report_latency("all", latencies, count * iterations);
+
+    report_state(&state);
+
+    int status = EXIT_SUCCESS;
+    if (check.diverged) {
+        fprintf(report, "\nERROR: replay diverged from the device at event %zu\n", check.event_index);
+        report_snapshot("device", check.expected);
+        report_snapshot("replay", check.actual);
+        status = EXIT_DIVERGED;
+    } else if (check.truncated) {
+        fprintf(report, "\nERROR: the device ran out of trace buffer at event %zu, the inputs after it were not recorded\n",
+                check.truncated_index);
+        fprintf(report, "  %zu earlier state(s) matched, but the state the trace was dumped in can't be checked\n", check.checked);
+        status = EXIT_TRUNCATED;
+    } else if (check.checked == 0) {
+        fprintf(report, "\nno state event in the trace, the final state was not checked against the device\n");
+    } else {
+        fprintf(report, "\nreplay matched the device at all %zu recorded state(s)\n", check.checked);
+    }
+    if (status == EXIT_SUCCESS && budget_us > 0 && p99 / 1000.0 > budget_us) {
+        fprintf(report, "\nERROR: p99 latency %.2f us exceeds the budget of %.2f us\n", p99 / 1000.0, budget_us);
+        status = EXIT_OVER_BUDGET;
+    }
+
+    fclose(report);
+    free(samples);
+    free(latencies);
+    free(events);
+    return status;
+}
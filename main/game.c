@@ -0,0 +1,464 @@
+//libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#else
+#define ESP_LOGI(tag, format, ...) ((void)(tag))
+#endif
+
+//game variables
+char board[3][3];
+char currentPlayer = 'X';
+bool mqtt_connected = false;
+bool game_started = false;
+game_mode_t current_mode = MODE_MENU;
+
+static const char *TAG = "TicTacToe";
+
+//put every game variable back to its power-on value
+void game_reset() {
+    initializeBoard();
+    currentPlayer = 'X';
+    mqtt_connected = false;
+    game_started = false;
+    current_mode = MODE_MENU;
+}
+
+//encode the game state into GAME_STATE_SIZE bytes, returns the number written
+int game_snapshot(uint8_t *out) {
+    int n = 0;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            out[n++] = board[i][j];
+    out[n++] = currentPlayer;
+    out[n++] = current_mode;
+    out[n++] = game_started;
+    out[n++] = mqtt_connected;
+    return n;
+}
+
+//mqtt connected
+void game_handle_mqtt_connected() {
+    mqtt_connected = true;
+
+    // if in the menu mode, display the menu
+    if (current_mode == MODE_MENU) {
+        display_menu();
+    }
+    //if in one-player mode and game not started, start it
+    else if (current_mode == MODE_ONE_PLAYER && !game_started) {
+        start_one_player_mode();
+    }
+    else if (current_mode == MODE_AI_PLAYERS && !game_started) {
+        start_automate_play_mode();
+    }
+}
+
+//mqtt disconnected
+void game_handle_mqtt_disconnected() {
+    mqtt_connected = false;
+}
+
+//mqtt data received on the control topic
+void game_handle_mqtt_data(const char *payload, int payload_len) {
+    //gandle MQTT data in both one-player and AI_PLAYERS modes
+    if ((current_mode == MODE_ONE_PLAYER && currentPlayer == 'O') ||
+        (current_mode == MODE_AI_PLAYERS && currentPlayer == 'O')) {
+
+        char data[32] = {0};
+        snprintf(data, sizeof(data), "%.*s", payload_len, payload);
+        char player;
+        int row, col;
+
+        if (sscanf(data, "%c,%d,%d", &player, &row, &col) == 3 && player == 'O') {
+            ESP_LOGI(TAG, "Received move: %c %d %d", player, row, col);
+
+            if (row >= 0 && row < 3 && col >= 0 && col < 3 && board[row][col] == ' ') {
+                board[row][col] = currentPlayer;
+                printBoard();  //print board after MQTT player's move
+
+                int winner = checkWinner();
+                if (winner) {
+                    if (winner == 3) {
+                        printf("It's a draw!\n");
+                    } else {
+                        printf("Player %c wins!\n", winner == 1 ? 'X' : 'O');
+                    }
+                    send_ready("done");
+                    //game is over, but keep the program running
+                    //return to menu after a brief delay
+                    game_delay_ms(3000);
+                    game_started = false;
+                    current_mode = MODE_MENU;
+                    display_menu();
+                } else {
+                    currentPlayer = 'X';
+
+                    if (current_mode == MODE_ONE_PLAYER) {
+                        printf("Human Player's turn (X)\n");
+                        printf("Enter row and column (0-2): ");
+                        fflush(stdout);
+                    } else if (current_mode == MODE_AI_PLAYERS) {
+                        printf("AI Player X's turn\n");
+                        //for AI mode, trigger the C program to make its move
+                        make_ai_move();
+                    }
+                    send_ready("next");
+                }
+            } else {
+                send_ready("taken");
+            }
+        }
+    }
+}
+
+//one complete line typed on the serial console
+void game_handle_uart_line(const char *input) {
+    //handle menu selection
+    if (current_mode == MODE_MENU) {
+        int selection = atoi(input);
+        handle_menu_selection(selection);
+    }
+    //handle game moves
+    else if (game_started) {
+        //in one-player mode, only process input when it's Player X's turn
+        if (current_mode == MODE_ONE_PLAYER && currentPlayer == 'X') {
+            int row, col;
+            if (sscanf(input, "%d %d", &row, &col) == 2) {
+                process_player_move(row, col);
+            } else {
+                printf("Invalid input. Format should be: row col\n");
+                printf("Enter row and column (0-2): ");
+                fflush(stdout);
+            }
+        }
+        //in two-player mode, process input for both players
+        else if (current_mode == MODE_TWO_PLAYER) {
+            int row, col;
+            if (sscanf(input, "%d %d", &row, &col) == 2) {
+                process_player_move(row, col);
+            } else {
+                printf("Invalid input. Format should be: row col\n");
+                printf("Enter row and column (0-2): ");
+                fflush(stdout);
+            }
+        }
+    }
+}
+
+//only make moves if in AI_PLAYERS mode, game has started, and it's X's turn
+bool game_ai_move_due() {
+    return current_mode == MODE_AI_PLAYERS && game_started && currentPlayer == 'X';
+}
+
+//one poll of the automated game task
+void game_handle_ai_tick() {
+    if (game_ai_move_due()) {
+        make_ai_move();
+    }
+}
+
+//display the main menu
+void display_menu() {
+    printf("\n\n=== ESP32 Tic-Tac-Toe ===\n");
+    printf("Select game mode:\n");
+    printf("1. One Player (vs. MQTT/Bash Script)\n");
+    printf("2. Two Players (Human vs. Human)\n");
+    printf("3. Automate Play\n");
+    printf("\nEnter your choice (1-3): ");
+    fflush(stdout);
+}
+
+//handle menu selection
+void handle_menu_selection(int selection) {
+    switch (selection) {
+        case 1:
+            current_mode = MODE_ONE_PLAYER;
+            if (mqtt_connected) {
+                start_one_player_mode();
+            } else {
+                printf("Waiting for MQTT connection to start game...\n");
+            }
+            break;
+        case 2:
+            current_mode = MODE_TWO_PLAYER;
+            start_two_player_mode();
+            break;
+        case 3:
+            current_mode = MODE_AI_PLAYERS;
+            if (mqtt_connected) {
+                start_automate_play_mode();
+            } else {
+                printf("Waiting for MQTT connection to start automated game...\n");
+            }
+            break;
+        default:
+            printf("Invalid selection. Please try again.\n");
+            display_menu();
+            break;
+    }
+}
+
+//start one-player mode (vs. MQTT)
+void start_one_player_mode() {
+    game_started = true;
+    currentPlayer = 'X';
+    initializeBoard();
+    send_ready("new"); //signal that a new game is starting
+
+    printf("\n=== One Player Mode ===\n");
+    printf("Player X = Human (Serial input)\n");
+    printf("Player O = Bash Script (MQTT input)\n\n");
+    printBoard();  //print initial empty board
+    printf("Human Player's turn (X)\n");
+    printf("Enter row and column (0-2): ");
+    fflush(stdout);
+}
+
+//start two-player mode (human vs. human)
+void start_two_player_mode() {
+    game_started = true;
+    currentPlayer = 'X';
+    initializeBoard();
+
+    printf("\n=== Two Player Mode ===\n");
+    printf("Player X and Player O both use serial input\n\n");
+    printBoard();  //print initial empty board
+    printf("Player %c's turn\n", currentPlayer);
+    printf("Enter row and column (0-2): ");
+    fflush(stdout);
+}
+
+//make an AI move for Player X (C program)
+void make_ai_move() {
+    //simple strategy - try random positions
+    //the random number generator is seeded once at startup (see app_main) so
+    //a recorded seed makes the random fallback below reproducible on replay
+    int row, col;
+    bool valid_move = false;
+
+    printf("AI Player X is thinking...\n");
+    game_delay_ms(1000); //add a small delay to simulate "thinking"
+
+    //look for a winning move
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            if (board[r][c] == ' ') {
+                //try this position
+                board[r][c] = 'X';
+                if (checkWinner() == 1) { //if X would win
+                    row = r;
+                    col = c;
+                    valid_move = true;
+                    board[r][c] = ' '; //undo the test move
+                    goto make_move; //found a winning move, break out
+                }
+                board[r][c] = ' '; //undo the test move
+            }
+        }
+    }
+
+    //look for a blocking move (if O would win next)
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            if (board[r][c] == ' ') {
+                //try this position for O
+                board[r][c] = 'O';
+                if (checkWinner() == 2) { //if O would win
+                    row = r;
+                    col = c;
+                    valid_move = true;
+                    board[r][c] = ' '; //undo the test move
+                    goto make_move; //found a blocking move, break out
+                }
+                board[r][c] = ' '; //undo the test move
+            }
+        }
+    }
+
+    //try center first if available (strategic)
+    if (board[1][1] == ' ') {
+        row = 1;
+        col = 1;
+        valid_move = true;
+        goto make_move;
+    }
+
+    //try corners next
+    int corners[4][2] = {{0,0}, {0,2}, {2,0}, {2,2}};
+    for (int i = 0; i < 4; i++) {
+        int r = corners[i][0];
+        int c = corners[i][1];
+        if (board[r][c] == ' ') {
+            row = r;
+            col = c;
+            valid_move = true;
+            goto make_move;
+        }
+    }
+
+    //otherwise try random positions until find a valid move
+    int attempts = 0;
+    while (!valid_move && attempts < 20) {
+        row = rand() % 3;
+        col = rand() % 3;
+        if (board[row][col] == ' ') {
+            valid_move = true;
+        }
+        attempts++;
+    }
+
+    //if still no valid move found after random attempts, find any empty cell
+    if (!valid_move) {
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                if (board[r][c] == ' ') {
+                    row = r;
+                    col = c;
+                    valid_move = true;
+                    goto make_move;
+                }
+            }
+        }
+    }
+
+//whenever the best move is found, jumps to here and processes the move
+make_move:
+    if (valid_move) {
+        printf("AI Player X chooses position: %d %d\n", row, col);
+        process_player_move(row, col);
+    } else {
+        printf("AI Player X couldn't find a valid move!\n");
+    }
+}
+
+//start automate play
+void start_automate_play_mode() {
+    game_started = true;
+    currentPlayer = 'X';
+    initializeBoard();
+    send_ready("new");  //signal that a new game is starting
+
+    printf("\n=== AI vs AI Mode ===\n");
+    printf("Player X (C program) vs Player O (bash script)\n\n");
+    printBoard();
+    printf("AI Player X's turn\n");
+
+    //trigger the C program AI to make its move
+    make_ai_move();
+}
+
+//process a player's move
+void process_player_move(int row, int col) {
+    //check if the move is valid
+    if (row >= 0 && row < 3 && col >= 0 && col < 3 && board[row][col] == ' ') {
+        board[row][col] = currentPlayer;
+        printBoard();
+
+        int winner = checkWinner();
+        if (winner) {
+            if (winner == 3) {
+                printf("It's a draw!\n");
+            } else {
+                printf("Player %c wins!\n", winner == 1 ? 'X' : 'O');
+            }
+
+            //notify via MQTT in either one-player or AI_PLAYERS mode
+            if ((current_mode == MODE_ONE_PLAYER || current_mode == MODE_AI_PLAYERS) && mqtt_connected) {
+                send_ready("done");
+            }
+
+            //return to menu after a delay
+            game_delay_ms(3000);
+            game_started = false;
+            current_mode = MODE_MENU;
+            display_menu();
+        } else {
+            //switch players
+            currentPlayer = (currentPlayer == 'X') ? 'O' : 'X';
+
+            //in one-player or AI_PLAYERS mode, notify MQTT if it's player O's turn
+            if (current_mode == MODE_ONE_PLAYER || current_mode == MODE_AI_PLAYERS) {
+                if (currentPlayer == 'O') {
+                    printf("Waiting for Player O's move via MQTT...\n");
+                    send_ready("next");
+                } else if (current_mode == MODE_ONE_PLAYER) {
+                    printf("Human Player's turn (X)\n");
+                    printf("Enter row and column (0-2): ");
+                    fflush(stdout);
+                } else {
+                    printf("AI Player X's turn\n");
+                    //in AI_PLAYERS mode, the automated_game_task will handle making the move
+                }
+            }
+            //in two-player mode, prompt the next player
+            else if (current_mode == MODE_TWO_PLAYER) {
+                printf("Player %c's turn\n", currentPlayer);
+                printf("Enter row and column (0-2): ");
+                fflush(stdout);
+            }
+        }
+    } else {
+        printf("Invalid move. Spot taken or out of range.\n");
+
+        //if in AI mode and invalid move attempted by AI player X, try again
+        if (current_mode == MODE_AI_PLAYERS && currentPlayer == 'X') {
+            printf("AI Player X is trying again...\n");
+            game_delay_ms(500);
+            make_ai_move();
+        } else if (current_mode != MODE_AI_PLAYERS) {
+            printf("Enter row and column (0-2): ");
+            fflush(stdout);
+        }
+    }
+}
+
+void initializeBoard() {
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            board[i][j] = ' ';
+}
+
+void printBoard() {
+    //board display
+    printf("\nCurrent board:\n\n");
+    for (int i = 0; i < 3; i++) {
+        printf(" %c | %c | %c \n", board[i][0], board[i][1], board[i][2]);
+        if (i < 2)
+            printf("---+---+---\n");
+    }
+    printf("\n");
+}
+
+int checkWinner() {
+    //check rows
+    for (int i = 0; i < 3; i++) {
+        if (board[i][0] == board[i][1] && board[i][1] == board[i][2] && board[i][0] != ' ')
+            return (board[i][0] == 'X') ? 1 : 2;
+    }
+
+    //check columns
+    for (int i = 0; i < 3; i++) {
+        if (board[0][i] == board[1][i] && board[1][i] == board[2][i] && board[0][i] != ' ')
+            return (board[0][i] == 'X') ? 1 : 2;
+    }
+
+    //check diagonals
+    if (board[0][0] == board[1][1] && board[1][1] == board[2][2] && board[0][0] != ' ')
+        return (board[0][0] == 'X') ? 1 : 2;
+    if (board[0][2] == board[1][1] && board[1][1] == board[2][0] && board[0][2] != ' ')
+        return (board[0][2] == 'X') ? 1 : 2;
+
+    //check for draw
+    int draw = 1;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            if (board[i][j] == ' ')
+                draw = 0;
+
+    return draw ? 3 : 0;
+}
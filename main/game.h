@@ -0,0 +1,52 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//game modes
+typedef enum {
+    MODE_MENU,
+    MODE_ONE_PLAYER,
+    MODE_TWO_PLAYER,
+    MODE_AI_PLAYERS
+} game_mode_t;
+
+//game variables
+extern char board[3][3];
+extern char currentPlayer;
+extern bool mqtt_connected;
+extern bool game_started;
+extern game_mode_t current_mode;
+
+//game logic
+void initializeBoard();
+void printBoard();
+int checkWinner();
+void display_menu();
+void handle_menu_selection(int selection);
+void start_one_player_mode();
+void start_two_player_mode();
+void start_automate_play_mode();
+void process_player_move(int row, int col);
+void make_ai_move();
+void game_reset();
+
+//encoded game state: the board row by row, current player, mode, game started, mqtt connected
+#define GAME_STATE_SIZE 13
+int game_snapshot(uint8_t *out);
+
+//input handlers, every input the game reacts to goes through one of these
+//so the same events can be recorded on the device and replayed on a host
+void game_handle_uart_line(const char *input);
+void game_handle_mqtt_connected();
+void game_handle_mqtt_disconnected();
+void game_handle_mqtt_data(const char *data, int data_len);
+bool game_ai_move_due();
+void game_handle_ai_tick();
+
+//platform hooks, implemented by tictactoe.c on the ESP32 and by the host replay tool
+void send_ready(const char* msg);
+void game_delay_ms(int ms);
+
+#endif
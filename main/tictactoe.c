@@ -10,27 +10,30 @@
 #include "esp_wifi.h"
 #include "esp_netif.h"
 #include "esp_task_wdt.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
+#include "game.h"
+#include "trace.h"
 
-//game modes
-typedef enum {
-    MODE_MENU,
-    MODE_ONE_PLAYER,
-    MODE_TWO_PLAYER,
-    MODE_AI_PLAYERS
-} game_mode_t;
-
-//game variables
-char board[3][3];
-char currentPlayer = 'X';
+//wifi state
 bool wifi_connected = false;
-bool mqtt_connected = false;
-bool game_started = false;
-game_mode_t current_mode = MODE_MENU;
 
 static esp_mqtt_client_handle_t client = NULL;
 static const char *TAG = "TicTacToe";
 
+//one input for the game task, TRACE_EVENT_STATE asks it to snapshot the game for a trace dump
+typedef struct {
+    trace_event_type_t type;
+    uint8_t len;
+    char data[65];
+} game_input_t;
+
+//the UART task and the MQTT callback only queue their inputs, the game task records
+//and handles them one at a time so the trace order is the order they actually ran in
+//the MQTT callback runs with the client locked and the game publishes, so it must never wait on the game
+static QueueHandle_t game_inputs = NULL;
+static TaskHandle_t uart_task_handle = NULL;
+
 //wifi config
 #define WIFI_SSID "Linksys03130"
 #define WIFI_PASS "0c2fzyk6dv"
@@ -39,21 +42,10 @@ static const char *TAG = "TicTacToe";
 #define UART_NUM UART_NUM_0
 #define BUF_SIZE (1024)
 
-void initializeBoard();
-void printBoard();
-void getPlayerMove();
-int checkWinner();
 void connect_wifi();
 void mqtt_app_start();
 void uart_task(void *pvParameters);
-void display_menu();
-void handle_menu_selection(int selection);
-void start_one_player_mode();
-void start_two_player_mode();
-void start_automate_play_mode();
-void process_player_move(int row, int col);
-void make_ai_move();
-void automated_game_task(void *pvParameters);
+void game_task(void *pvParameters);
 
 //publish ready status
 void send_ready(const char* msg) {
@@ -63,84 +55,45 @@ void send_ready(const char* msg) {
     }
 }
 
+//block the calling task, used by the game for its "thinking" and end of game pauses
+void game_delay_ms(int ms) {
+    vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+//hand an input to the game task, returns false if the queue is full
+static bool queue_game_input(trace_event_type_t type, const char *data, int len, TickType_t wait) {
+    game_input_t input = { .type = type };
+    if (len > (int)sizeof(input.data) - 1) {
+        len = sizeof(input.data) - 1;
+    }
+    if (len > 0) {
+        memcpy(input.data, data, len);
+        input.len = len;
+    }
+    if (xQueueSend(game_inputs, &input, wait) != pdTRUE) {
+        ESP_LOGW(TAG, "Game input queue full, dropped %s", trace_event_name(type));
+        return false;
+    }
+    return true;
+}
+
 //mqtt event callback
 static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event) {
     switch (event->event_id) {
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT Connected");
-            mqtt_connected = true;
             esp_mqtt_client_subscribe(client, "tictactoe/control", 0);
-            
-            // if in the menu mode, display the menu
-            if (current_mode == MODE_MENU) {
-                display_menu();
-            }
-            //if in one-player mode and game not started, start it
-            else if (current_mode == MODE_ONE_PLAYER && !game_started) {
-                start_one_player_mode();
-            }
-            else if (current_mode == MODE_AI_PLAYERS && !game_started) {
-                start_automate_play_mode();
-            }
+            queue_game_input(TRACE_EVENT_MQTT_CONNECTED, NULL, 0, 0);
             break;
             
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "MQTT Disconnected");
-            mqtt_connected = false;
+            queue_game_input(TRACE_EVENT_MQTT_DISCONNECTED, NULL, 0, 0);
             break;
             
         case MQTT_EVENT_DATA:
             ESP_LOGI(TAG, "MQTT Data Received");
-
-            //gandle MQTT data in both one-player and AI_PLAYERS modes
-            if ((current_mode == MODE_ONE_PLAYER && currentPlayer == 'O') || 
-                (current_mode == MODE_AI_PLAYERS && currentPlayer == 'O')) {
-                
-                char data[32] = {0};
-                snprintf(data, sizeof(data), "%.*s", event->data_len, event->data);
-                char player;
-                int row, col;
-                
-                if (sscanf(data, "%c,%d,%d", &player, &row, &col) == 3 && player == 'O') {
-                    ESP_LOGI(TAG, "Received move: %c %d %d", player, row, col);
-
-                    if (row >= 0 && row < 3 && col >= 0 && col < 3 && board[row][col] == ' ') {
-                        board[row][col] = currentPlayer;
-                        printBoard();  //print board after MQTT player's move
-                        
-                        int winner = checkWinner();
-                        if (winner) {
-                            if (winner == 3) {
-                                printf("It's a draw!\n");
-                            } else {
-                                printf("Player %c wins!\n", winner == 1 ? 'X' : 'O');
-                            }
-                            send_ready("done");
-                            //game is over, but keep the program running
-                            //return to menu after a brief delay
-                            vTaskDelay(3000 / portTICK_PERIOD_MS);
-                            game_started = false;
-                            current_mode = MODE_MENU;
-                            display_menu();
-                        } else {
-                            currentPlayer = 'X';
-                            
-                            if (current_mode == MODE_ONE_PLAYER) {
-                                printf("Human Player's turn (X)\n");
-                                printf("Enter row and column (0-2): ");
-                                fflush(stdout);
-                            } else if (current_mode == MODE_AI_PLAYERS) {
-                                printf("AI Player X's turn\n");
-                                //for AI mode, trigger the C program to make its move
-                                make_ai_move();
-                            }
-                            send_ready("next");
-                        }
-                    } else {
-                        send_ready("taken");
-                    }
-                }
-            }
+            queue_game_input(TRACE_EVENT_MQTT_DATA, event->data, event->data_len, 0);
             break;
             
         default:
@@ -176,275 +129,53 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
     }
 }
 
-//display the main menu
-void display_menu() {
-    printf("\n\n=== ESP32 Tic-Tac-Toe ===\n");
-    printf("Select game mode:\n");
-    printf("1. One Player (vs. MQTT/Bash Script)\n");
-    printf("2. Two Players (Human vs. Human)\n");
-    printf("3. Automate Play\n");
-    printf("\nEnter your choice (1-3): ");
-    fflush(stdout);
-}
+//the only task that runs game code, it records each input right before handling it
+void game_task(void *pvParameters) {
+    game_input_t input;
+    TickType_t next_poll = xTaskGetTickCount() + 500 / portTICK_PERIOD_MS;
 
-//handle menu selection
-void handle_menu_selection(int selection) {
-    switch (selection) {
-        case 1:
-            current_mode = MODE_ONE_PLAYER;
-            if (mqtt_connected) {
-                start_one_player_mode();
-            } else {
-                printf("Waiting for MQTT connection to start game...\n");
-            }
-            break;
-        case 2:
-            current_mode = MODE_TWO_PLAYER;
-            start_two_player_mode();
-            break;
-        case 3:
-            current_mode = MODE_AI_PLAYERS;
-            if (mqtt_connected) {
-                start_automate_play_mode();
-            } else {
-                printf("Waiting for MQTT connection to start automated game...\n");
-            }
-            break;
-        default:
-            printf("Invalid selection. Please try again.\n");
-            display_menu();
-            break;
-    }
-}
-
-//start one-player mode (vs. MQTT)
-void start_one_player_mode() {
-    game_started = true;
-    currentPlayer = 'X';
-    initializeBoard();
-    send_ready("new"); //signal that a new game is starting
-    
-    printf("\n=== One Player Mode ===\n");
-    printf("Player X = Human (Serial input)\n");
-    printf("Player O = Bash Script (MQTT input)\n\n");
-    printBoard();  //print initial empty board
-    printf("Human Player's turn (X)\n");
-    printf("Enter row and column (0-2): ");
-    fflush(stdout);
-}
-
-//start two-player mode (human vs. human)
-void start_two_player_mode() {
-    game_started = true;
-    currentPlayer = 'X';
-    initializeBoard();
-    
-    printf("\n=== Two Player Mode ===\n");
-    printf("Player X and Player O both use serial input\n\n");
-    printBoard();  //print initial empty board
-    printf("Player %c's turn\n", currentPlayer);
-    printf("Enter row and column (0-2): ");
-    fflush(stdout);
-}
-
-//make an AI move for Player X (C program)
-void make_ai_move() {
-    //simple strategy - try random positions
-    int row, col;
-    bool valid_move = false;
-    
-    //seed the random number generator if this is the first AI move
-    static bool seeded = false;
-    if (!seeded) {
-        srand(time(NULL));
-        seeded = true;
-    }
-    
-    printf("AI Player X is thinking...\n");
-    vTaskDelay(1000 / portTICK_PERIOD_MS); //add a small delay to simulate "thinking"
-    
-    //look for a winning move
-    for (int r = 0; r < 3; r++) {
-        for (int c = 0; c < 3; c++) {
-            if (board[r][c] == ' ') {
-                //try this position
-                board[r][c] = 'X';
-                if (checkWinner() == 1) { //if X would win
-                    row = r;
-                    col = c;
-                    valid_move = true;
-                    board[r][c] = ' '; //undo the test move
-                    goto make_move; //found a winning move, break out
-                }
-                board[r][c] = ' '; //undo the test move
-            }
-        }
-    }
-    
-    //look for a blocking move (if O would win next)
-    for (int r = 0; r < 3; r++) {
-        for (int c = 0; c < 3; c++) {
-            if (board[r][c] == ' ') {
-                //try this position for O
-                board[r][c] = 'O';
-                if (checkWinner() == 2) { //if O would win
-                    row = r;
-                    col = c;
-                    valid_move = true;
-                    board[r][c] = ' '; //undo the test move
-                    goto make_move; //found a blocking move, break out
-                }
-                board[r][c] = ' '; //undo the test move
-            }
-        }
-    }
-    
-    //try center first if available (strategic)
-    if (board[1][1] == ' ') {
-        row = 1;
-        col = 1;
-        valid_move = true;
-        goto make_move;
-    }
-    
-    //try corners next
-    int corners[4][2] = {{0,0}, {0,2}, {2,0}, {2,2}};
-    for (int i = 0; i < 4; i++) {
-        int r = corners[i][0];
-        int c = corners[i][1];
-        if (board[r][c] == ' ') {
-            row = r;
-            col = c;
-            valid_move = true;
-            goto make_move;
-        }
-    }
-    
-    //otherwise try random positions until find a valid move
-    int attempts = 0;
-    while (!valid_move && attempts < 20) {
-        row = rand() % 3;
-        col = rand() % 3;
-        if (board[row][col] == ' ') {
-            valid_move = true;
-        }
-        attempts++;
-    }
-    
-    //if still no valid move found after random attempts, find any empty cell
-    if (!valid_move) {
-        for (int r = 0; r < 3; r++) {
-            for (int c = 0; c < 3; c++) {
-                if (board[r][c] == ' ') {
-                    row = r;
-                    col = c;
-                    valid_move = true;
-                    goto make_move;
-                }
-            }
-        }
-    }
-
-//whenever the best move is found, jumps to here and processes the move
-make_move:
-    if (valid_move) {
-        printf("AI Player X chooses position: %d %d\n", row, col);
-        process_player_move(row, col);
-    } else {
-        printf("AI Player X couldn't find a valid move!\n");
-    }
-}
-
-//function to handle the automated game task
-void automated_game_task(void *pvParameters) {
     while (1) {
-        //only make moves if in AI_PLAYERS mode, game has started, and it's X's turn
-        if (current_mode == MODE_AI_PLAYERS && game_started && currentPlayer == 'X') {
-            make_ai_move();
-        }
-        
-        //sleep before checking again
-        vTaskDelay(500 / portTICK_PERIOD_MS);
-    }
-}
-
-//start automate play
-void start_automate_play_mode() {
-    game_started = true;
-    currentPlayer = 'X';
-    initializeBoard();
-    send_ready("new");  //signal that a new game is starting
-
-    printf("\n=== AI vs AI Mode ===\n");
-    printf("Player X (C program) vs Player O (bash script)\n\n");
-    printBoard();
-    printf("AI Player X's turn\n");
-    
-    //trigger the C program AI to make its move
-    make_ai_move();
-}
-
-//process a player's move
-void process_player_move(int row, int col) {
-    //check if the move is valid
-    if (row >= 0 && row < 3 && col >= 0 && col < 3 && board[row][col] == ' ') {
-        board[row][col] = currentPlayer;
-        printBoard();
-        
-        int winner = checkWinner();
-        if (winner) {
-            if (winner == 3) {
-                printf("It's a draw!\n");
-            } else {
-                printf("Player %c wins!\n", winner == 1 ? 'X' : 'O');
-            }
-            
-            //notify via MQTT in either one-player or AI_PLAYERS mode
-            if ((current_mode == MODE_ONE_PLAYER || current_mode == MODE_AI_PLAYERS) && mqtt_connected) {
-                send_ready("done");
-            }
-            
-            //return to menu after a delay
-            vTaskDelay(3000 / portTICK_PERIOD_MS);
-            game_started = false;
-            current_mode = MODE_MENU;
-            display_menu();
-        } else {
-            //switch players
-            currentPlayer = (currentPlayer == 'X') ? 'O' : 'X';
-            
-            //in one-player or AI_PLAYERS mode, notify MQTT if it's player O's turn
-            if (current_mode == MODE_ONE_PLAYER || current_mode == MODE_AI_PLAYERS) {
-                if (currentPlayer == 'O') {
-                    printf("Waiting for Player O's move via MQTT...\n");
-                    send_ready("next");
-                } else if (current_mode == MODE_ONE_PLAYER) {
-                    printf("Human Player's turn (X)\n");
-                    printf("Enter row and column (0-2): ");
-                    fflush(stdout);
-                } else {
-                    printf("AI Player X's turn\n");
-                    //in AI_PLAYERS mode, the automated_game_task will handle making the move
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = (int32_t)(next_poll - now) > 0 ? next_poll - now : 0;
+
+        if (xQueueReceive(game_inputs, &input, wait) == pdTRUE) {
+            input.data[input.len] = '\0';
+            switch (input.type) {
+                case TRACE_EVENT_UART_LINE:
+                    trace_record(input.type, input.data, input.len);
+                    game_handle_uart_line(input.data);
+                    break;
+                case TRACE_EVENT_MQTT_CONNECTED:
+                    trace_record(input.type, NULL, 0);
+                    game_handle_mqtt_connected();
+                    break;
+                case TRACE_EVENT_MQTT_DISCONNECTED:
+                    trace_record(input.type, NULL, 0);
+                    game_handle_mqtt_disconnected();
+                    break;
+                case TRACE_EVENT_MQTT_DATA:
+                    trace_record(input.type, input.data, input.len);
+                    game_handle_mqtt_data(input.data, input.len);
+                    break;
+                case TRACE_EVENT_STATE: {
+                    //record where the game is so the replay can check it ends up there too,
+                    //the UART task prints the trace so the game isn't held up while it does
+                    uint8_t state[GAME_STATE_SIZE];
+                    trace_record(TRACE_EVENT_STATE, state, game_snapshot(state));
+                    xTaskNotifyGive(uart_task_handle);
+                    break;
                 }
-            } 
-            //in two-player mode, prompt the next player
-            else if (current_mode == MODE_TWO_PLAYER) {
-                printf("Player %c's turn\n", currentPlayer);
-                printf("Enter row and column (0-2): ");
-                fflush(stdout);
+                default:
+                    break;
             }
+            continue;
         }
-    } else {
-        printf("Invalid move. Spot taken or out of range.\n");
-        
-        //if in AI mode and invalid move attempted by AI player X, try again
-        if (current_mode == MODE_AI_PLAYERS && currentPlayer == 'X') {
-            printf("AI Player X is trying again...\n");
-            vTaskDelay(500 / portTICK_PERIOD_MS);
-            make_ai_move();
-        } else if (current_mode != MODE_AI_PLAYERS) {
-            printf("Enter row and column (0-2): ");
-            fflush(stdout);
+
+        //every 500 ms, only make moves if in AI_PLAYERS mode, game has started, and it's X's turn
+        next_poll = xTaskGetTickCount() + 500 / portTICK_PERIOD_MS;
+        if (game_ai_move_due()) {
+            trace_record(TRACE_EVENT_AI_TICK, NULL, 0);
+            game_handle_ai_tick();
         }
     }
 }
@@ -466,35 +197,14 @@ void uart_task(void *pvParameters) {
                     input[idx] = '\0';
                     idx = 0;
                     
-                    //handle menu selection
-                    if (current_mode == MODE_MENU) {
-                        int selection = atoi(input);
-                        handle_menu_selection(selection);
-                    }
-                    //handle game moves
-                    else if (game_started) {
-                        //in one-player mode, only process input when it's Player X's turn
-                        if (current_mode == MODE_ONE_PLAYER && currentPlayer == 'X') {
-                            int row, col;
-                            if (sscanf(input, "%d %d", &row, &col) == 2) {
-                                process_player_move(row, col);
-                            } else {
-                                printf("Invalid input. Format should be: row col\n");
-                                printf("Enter row and column (0-2): ");
-                                fflush(stdout);
-                            }
-                        }
-                        //in two-player mode, process input for both players
-                        else if (current_mode == MODE_TWO_PLAYER) {
-                            int row, col;
-                            if (sscanf(input, "%d %d", &row, &col) == 2) {
-                                process_player_move(row, col);
-                            } else {
-                                printf("Invalid input. Format should be: row col\n");
-                                printf("Enter row and column (0-2): ");
-                                fflush(stdout);
-                            }
+                    //dump the recorded input trace once the game task has recorded its state
+                    if (strcmp(input, "trace") == 0) {
+                        if (queue_game_input(TRACE_EVENT_STATE, NULL, 0, portMAX_DELAY)) {
+                            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                            trace_dump();
                         }
+                    } else {
+                        queue_game_input(TRACE_EVENT_UART_LINE, input, strlen(input), portMAX_DELAY);
                     }
                 }
                 //print a new line for better formatting
@@ -517,8 +227,13 @@ void uart_task(void *pvParameters) {
 void app_main() {
     ESP_LOGI(TAG, "Initializing...");
     
+    game_inputs = xQueueCreate(16, sizeof(game_input_t));
+    
     //initialize random number generator for AI moves
-    srand(time(NULL));
+    //the seed is the first trace event so replays make the same random choices
+    uint32_t seed = (uint32_t)time(NULL);
+    srand(seed);
+    trace_record_seed(seed);
     
     //initialize NVS
     esp_err_t ret = nvs_flash_init();
@@ -548,10 +263,10 @@ void app_main() {
     ESP_ERROR_CHECK(uart_driver_install(UART_NUM, BUF_SIZE * 2, 0, 0, NULL, 0));
     
     //create a task to handle UART input
-    xTaskCreate(uart_task, "uart_task", 4096, NULL, 10, NULL);
+    xTaskCreate(uart_task, "uart_task", 4096, NULL, 10, &uart_task_handle);
     
-    //create a task to handle automated play
-    xTaskCreate(automated_game_task, "automated_game_task", 4096, NULL, 5, NULL);
+    //create the task that runs the game and handles automated play
+    xTaskCreate(game_task, "game_task", 4096, NULL, 5, NULL);
     
     //connect to WiFi (MQTT will start once WiFi connects)
     printf("Connecting to WiFi...\n");
@@ -604,49 +319,3 @@ void mqtt_app_start() {
     esp_mqtt_client_start(client);
 }
 
-
-void initializeBoard() {
-    for (int i = 0; i < 3; i++)
-        for (int j = 0; j < 3; j++)
-            board[i][j] = ' ';
-}
-
-void printBoard() {
-    //board display
-    printf("\nCurrent board:\n\n");
-    for (int i = 0; i < 3; i++) {
-        printf(" %c | %c | %c \n", board[i][0], board[i][1], board[i][2]);
-        if (i < 2)
-            printf("---+---+---\n");
-    }
-    printf("\n");
-}
-
-int checkWinner() {
-    //check rows
-    for (int i = 0; i < 3; i++) {
-        if (board[i][0] == board[i][1] && board[i][1] == board[i][2] && board[i][0] != ' ')
-            return (board[i][0] == 'X') ? 1 : 2;
-    }
-    
-    //check columns
-    for (int i = 0; i < 3; i++) {
-        if (board[0][i] == board[1][i] && board[1][i] == board[2][i] && board[0][i] != ' ')
-            return (board[0][i] == 'X') ? 1 : 2;
-    }
-
-    //check diagonals
-    if (board[0][0] == board[1][1] && board[1][1] == board[2][2] && board[0][0] != ' ')
-        return (board[0][0] == 'X') ? 1 : 2;
-    if (board[0][2] == board[1][1] && board[1][1] == board[2][0] && board[0][2] != ' ')
-        return (board[0][2] == 'X') ? 1 : 2;
-
-    //check for draw
-    int draw = 1;
-    for (int i = 0; i < 3; i++)
-        for (int j = 0; j < 3; j++)
-            if (board[i][j] == ' ')
-                draw = 0;
-
-    return draw ? 3 : 0;
-}
\ No newline at end of file
@@ -0,0 +1,112 @@
+//libraries
+#include <string.h>
+#include "trace.h"
+
+static const char *event_names[TRACE_EVENT_COUNT] = {
+    [TRACE_EVENT_SEED] = "seed",
+    [TRACE_EVENT_UART_LINE] = "uart_line",
+    [TRACE_EVENT_MQTT_CONNECTED] = "mqtt_connected",
+    [TRACE_EVENT_MQTT_DISCONNECTED] = "mqtt_disconnected",
+    [TRACE_EVENT_MQTT_DATA] = "mqtt_data",
+    [TRACE_EVENT_AI_TICK] = "ai_tick",
+    [TRACE_EVENT_STATE] = "state",
+    [TRACE_EVENT_TRUNCATED] = "truncated",
+};
+
+//write the trace header, returns the number of bytes written or 0 if it doesn't fit
+size_t trace_write_header(uint8_t *out, size_t cap) {
+    if (cap < TRACE_HEADER_SIZE) {
+        return 0;
+    }
+    memcpy(out, TRACE_MAGIC, 4);
+    out[4] = TRACE_VERSION;
+    out[5] = 0;
+    return TRACE_HEADER_SIZE;
+}
+
+//append one event, returns the number of bytes written or 0 if it doesn't fit
+size_t trace_encode_event(uint8_t *out, size_t cap, uint64_t delta_us, uint8_t type, const void *payload, size_t len) {
+    uint8_t tmp[10];
+    size_t n = 0;
+
+    if (len > TRACE_MAX_PAYLOAD) {
+        len = TRACE_MAX_PAYLOAD;
+    }
+
+    //varint timestamp delta, 7 bits per byte, low bits first
+    do {
+        uint8_t byte = delta_us & 0x7f;
+        delta_us >>= 7;
+        tmp[n++] = delta_us ? (byte | 0x80) : byte;
+    } while (delta_us);
+
+    if (n + 2 + len > cap) {
+        return 0;
+    }
+    memcpy(out, tmp, n);
+    out[n++] = type;
+    out[n++] = (uint8_t)len;
+    if (len > 0) {
+        memcpy(out + n, payload, len);
+    }
+    return n + len;
+}
+
+//check the magic and version at the start of a trace
+bool trace_read_header(const uint8_t *in, size_t len) {
+    return len >= TRACE_HEADER_SIZE && memcmp(in, TRACE_MAGIC, 4) == 0 && in[4] == TRACE_VERSION;
+}
+
+//decode the event at *pos and advance past it
+//returns 1 for an event, 0 at the end of the trace and -1 if the trace is corrupt
+int trace_decode_event(const uint8_t *in, size_t len, size_t *pos, trace_event_t *event) {
+    size_t p = *pos;
+    uint64_t delta = 0;
+    int shift = 0;
+
+    if (p >= len) {
+        return 0;
+    }
+
+    while (1) {
+        if (p >= len || shift > 63) {
+            return -1;
+        }
+        uint8_t byte = in[p++];
+        delta |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+
+    if (p + 2 > len) {
+        return -1;
+    }
+    event->delta_us = delta;
+    event->type = in[p++];
+    event->len = in[p++];
+    if (event->type == 0 || event->type >= TRACE_EVENT_COUNT || p + event->len > len) {
+        return -1;
+    }
+    memcpy(event->payload, in + p, event->len);
+    event->payload[event->len] = '\0';
+    *pos = p + event->len;
+    return 1;
+}
+
+//seed events carry the srand() seed as 4 little-endian bytes
+uint32_t trace_seed_from_event(const trace_event_t *event) {
+    uint32_t seed = 0;
+    for (int i = 0; i < 4 && i < event->len; i++) {
+        seed |= (uint32_t)event->payload[i] << (8 * i);
+    }
+    return seed;
+}
+
+const char *trace_event_name(uint8_t type) {
+    if (type == 0 || type >= TRACE_EVENT_COUNT) {
+        return "unknown";
+    }
+    return event_names[type];
+}
@@ -0,0 +1,69 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//input trace format
+//
+//a trace is a 6 byte header followed by back-to-back events:
+//  header: 'T' 'T' 'T' 'R', version, reserved (0)
+//  event:  time since previous event in microseconds (LEB128 varint),
+//          event type (1 byte), payload length (1 byte), payload
+//
+//the seed event stores the srand() seed as 4 little-endian bytes, the state
+//event stores the game_snapshot() taken on the device when the trace was dumped,
+//the truncated event has no payload, nothing was recorded after it,
+//every other payload is the raw text the game received (no terminator)
+
+#define TRACE_MAGIC "TTTR"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 6
+#define TRACE_MAX_PAYLOAD 255
+//worst case encoded size of a single event
+#define TRACE_MAX_EVENT_SIZE (10 + 2 + TRACE_MAX_PAYLOAD)
+//worst case encoded size of an event without payload
+#define TRACE_MARKER_SIZE (10 + 2)
+
+//size of the recording buffer on the device, recording stops at the first event
+//that doesn't fit and a truncated event marks the spot
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE (8 * 1024)
+#endif
+
+//event types
+typedef enum {
+    TRACE_EVENT_SEED = 1,
+    TRACE_EVENT_UART_LINE,
+    TRACE_EVENT_MQTT_CONNECTED,
+    TRACE_EVENT_MQTT_DISCONNECTED,
+    TRACE_EVENT_MQTT_DATA,
+    TRACE_EVENT_AI_TICK,
+    TRACE_EVENT_STATE,
+    TRACE_EVENT_TRUNCATED,
+    TRACE_EVENT_COUNT
+} trace_event_type_t;
+
+//one decoded event
+typedef struct {
+    uint64_t delta_us;
+    uint8_t type;
+    uint8_t len;
+    uint8_t payload[TRACE_MAX_PAYLOAD + 1]; //always '\0' terminated
+} trace_event_t;
+
+//encoding and decoding (trace.c), shared by the device and the host replay tool
+size_t trace_write_header(uint8_t *out, size_t cap);
+size_t trace_encode_event(uint8_t *out, size_t cap, uint64_t delta_us, uint8_t type, const void *payload, size_t len);
+bool trace_read_header(const uint8_t *in, size_t len);
+int trace_decode_event(const uint8_t *in, size_t len, size_t *pos, trace_event_t *event);
+uint32_t trace_seed_from_event(const trace_event_t *event);
+const char *trace_event_name(uint8_t type);
+
+//recording on the device (trace_recorder.c)
+void trace_record(trace_event_type_t type, const void *payload, size_t len);
+void trace_record_seed(uint32_t seed);
+void trace_dump();
+
+#endif
@@ -0,0 +1,86 @@
+//libraries
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "trace.h"
+
+//events are recorded by the game task and read by the UART task when it dumps,
+//so appends and the length snapshot are serialized with a spinlock
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t trace_buf[TRACE_BUFFER_SIZE];
+static size_t trace_len = 0;
+static int64_t trace_last_us = 0;
+static bool trace_full = false;
+static unsigned trace_dropped = 0;
+
+static const char *TAG = "Trace";
+
+//record one event
+//inputs leave room for one state event and the truncation marker, so the state
+//taken for a dump still fits when the inputs before it did. the first event that
+//doesn't fit writes the marker and nothing is recorded after it, so a trace never
+//has holes in the middle
+void trace_record(trace_event_type_t type, const void *payload, size_t len) {
+    portENTER_CRITICAL(&trace_lock);
+    int64_t now = esp_timer_get_time();
+    if (trace_len == 0) {
+        trace_len = trace_write_header(trace_buf, sizeof(trace_buf));
+        trace_last_us = now;
+    }
+    if (trace_full) {
+        trace_dropped++;
+        portEXIT_CRITICAL(&trace_lock);
+        return;
+    }
+
+    size_t reserve = TRACE_MARKER_SIZE;
+    if (type != TRACE_EVENT_STATE) {
+        reserve += TRACE_MAX_EVENT_SIZE;
+    }
+    size_t room = sizeof(trace_buf) - trace_len > reserve ? sizeof(trace_buf) - trace_len - reserve : 0;
+    uint64_t delta = (uint64_t)(now - trace_last_us);
+    size_t n = trace_encode_event(trace_buf + trace_len, room, delta, type, payload, len);
+    if (n == 0) {
+        n = trace_encode_event(trace_buf + trace_len, sizeof(trace_buf) - trace_len, delta,
+                               TRACE_EVENT_TRUNCATED, NULL, 0);
+        trace_full = true;
+        trace_dropped++;
+    }
+    trace_len += n;
+    trace_last_us = now;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+//record the srand() seed so the AI's random fallback replays the same way
+void trace_record_seed(uint32_t seed) {
+    uint8_t bytes[4] = {seed & 0xff, (seed >> 8) & 0xff, (seed >> 16) & 0xff, (seed >> 24) & 0xff};
+    trace_record(TRACE_EVENT_SEED, bytes, sizeof(bytes));
+}
+
+//print the trace as hex lines so it can be captured from the serial monitor
+//and fed straight to the host replay tool
+void trace_dump() {
+    //the buffer is append-only, everything before the snapshot is stable
+    portENTER_CRITICAL(&trace_lock);
+    size_t len = trace_len;
+    unsigned dropped = trace_dropped;
+    portEXIT_CRITICAL(&trace_lock);
+
+    if (dropped > 0) {
+        ESP_LOGW(TAG, "Trace buffer full, %u events were not recorded", dropped);
+    }
+
+    //each line goes out in a single printf so output from other tasks can't split it
+    char line[8 + 2 * 32];
+    printf("\nTRACE-BEGIN %u\n", (unsigned)len);
+    for (size_t i = 0; i < len; i += 32) {
+        int n = sprintf(line, "TRACE:");
+        for (size_t j = i; j < len && j < i + 32; j++) {
+            n += sprintf(line + n, "%02x", trace_buf[j]);
+        }
+        printf("%s\n", line);
+    }
+    printf("TRACE-END\n");
+    fflush(stdout);
+}